@@ -0,0 +1,497 @@
+#include "CLICHIP_8_core.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+
+
+
+
+/* Constant values */
+#define CONST_ARGC_MIN 2
+#define CONST_ARGC_MAX 3  // Optional --update flag
+#define CONST_UPDATE_FLAG "--update"
+
+#define CONST_MANIFEST_ENTRIES_MAX 256
+#define CONST_MANIFEST_LINE_SIZE 512
+#define CONST_MANIFEST_PATH_SIZE 256
+#define CONST_MANIFEST_KEYS_SIZE 64
+#define CONST_MANIFEST_COMMENT '#'
+#define CONST_MANIFEST_NO_GOLDEN "-"
+#define CONST_GOLDEN_SUFFIX ".golden"
+
+#define CONST_HASH_SEED 0x243F6A8885A308D3ULL
+#define CONST_HASH_MULTIPLIER 0x9E3779B97F4A7C15ULL
+#define CONST_HASH_SHIFT 29
+
+#define CONST_DIFF_CHARACTER_ADDED '+'  // Set in the result, unset in the golden framebuffer
+#define CONST_DIFF_CHARACTER_REMOVED '-'  // Unset in the result, set in the golden framebuffer
+
+
+
+
+/* Data structures */
+/* struct conformanceresult - what a worker sends back after running a ROM */
+struct conformanceresult
+{
+        __uint64_t hash;
+        __uint64_t display[CONST_DISPLAY_SIZE_Y];
+        __uint8_t status;
+};
+
+/* struct conformancecase - one manifest line, comments and blank lines are kept only to rewrite the manifest */
+struct conformancecase
+{
+        char line[CONST_MANIFEST_LINE_SIZE];
+        char rom[CONST_MANIFEST_PATH_SIZE];  // ROM path as written in the manifest
+        char path[CONST_MANIFEST_PATH_SIZE << 1];  // ROM path relative to the working directory
+        char keys[CONST_MANIFEST_KEYS_SIZE];  // Hex digits fed to the keyboard, in order
+        __uint32_t cycles;
+        __uint64_t golden;
+        __uint8_t isEntry;
+        __uint8_t hasGolden;
+        pid_t pid;
+        int pipeFd;
+        struct conformanceresult result;
+};
+
+static struct conformancecase cases[CONST_MANIFEST_ENTRIES_MAX];
+static __uint16_t caseCount;
+
+static const char *keys;
+static __uint8_t keyPos;
+
+
+
+
+/* Functions */
+/* Feeds the hex digits from the manifest to the keyboard, then keeps returning 0 */
+static __uint8_t conformance_keyboard_input(void)
+{
+        char digit[2] = {keys[keyPos], 0};
+
+        if (digit[0] == 0)
+        {
+                return 0;
+        }
+        keyPos++;
+
+        return (__uint8_t) strtoul(digit, NULL, 16);
+}
+
+/* Mixes one 64-bit word into the hash */
+static inline __uint64_t hash_word(__uint64_t hash, __uint64_t word)
+{
+        hash = (hash ^ word) * CONST_HASH_MULTIPLIER;
+        return hash ^ (hash >> CONST_HASH_SHIFT);
+}
+
+/* Hashes the memory, display, registers and PC, 8 bytes at a time */
+static __uint64_t hash_state(void)
+{
+        __uint64_t hash = CONST_HASH_SEED, word;
+        __uint16_t idx;
+
+        for (idx = 0; idx < CONST_MEMORY_SIZE_TOTAL; idx += sizeof(__uint64_t))
+        {
+                memcpy(&word, state.mem + idx, sizeof(__uint64_t));
+                hash = hash_word(hash, word);
+        }
+        for (idx = 0; idx < CONST_DISPLAY_SIZE_Y; idx++)
+        {
+                hash = hash_word(hash, state.display[idx]);
+        }
+        for (idx = 0; idx < CONST_REGISTERS_COUNT; idx += sizeof(__uint64_t))
+        {
+                memcpy(&word, state.regs.regV + idx, sizeof(__uint64_t));
+                hash = hash_word(hash, word);
+        }
+
+        return hash_word(hash, ((__uint64_t) state.regs.regI << 16) | state.PC);
+}
+
+/* Runs a ROM for its cycle count from a clean state, meant to be called in a worker process */
+static void run_rom(const struct conformancecase *entry, struct conformanceresult *result)
+{
+        FILE *inputFile;
+        __uint16_t oldPC;
+
+        result->status = CONST_NOK;
+
+        memset(&state, 0, sizeof(struct hwstate));
+        if (setup_memory() != CONST_OK)
+        {
+                return;
+        }
+        state.PC = CONST_MEMORY_START_PROGRAM;
+        setup_fonts();
+
+        inputFile = fopen(entry->path, "rb");
+        if (inputFile == NULL)
+        {
+                printf("Opening input file %s returned error\n", entry->path);
+                return;
+        }
+        if (fread(state.mem + CONST_MEMORY_START_PROGRAM, 1, CONST_MEMORY_SIZE_PROGRAM, inputFile) == 0)
+        {
+                printf("Could not read any bytes from %s\n", entry->path);
+                fclose(inputFile);
+                return;
+        }
+        fclose(inputFile);
+
+        // CXNN has to give the same numbers on every run
+        srand(0);
+        keys = entry->keys;
+        keyPos = 0;
+
+        for (__uint32_t cycles = entry->cycles; cycles > 0; cycles--)
+        {
+                oldPC = state.PC;
+                execute_instruction();
+                if (state.PC == oldPC)
+                {
+                        // Nothing changes anymore, the rest of the cycles would end in the same state
+                        break;
+                }
+        }
+
+        result->hash = hash_state();
+        memcpy(result->display, state.display, sizeof(state.display));
+        result->status = CONST_OK;
+}
+
+/* Reads the manifest, every entry line is "<ROM path> <cycles> <golden hash or -> [hex keys]" */
+static __uint8_t read_manifest(const char *manifest)
+{
+        char directory[CONST_MANIFEST_PATH_SIZE], golden[CONST_MANIFEST_LINE_SIZE];
+        const char *slash = strrchr(manifest, '/');
+        FILE *manifestFile;
+        struct conformancecase *entry;
+        int fields;
+        size_t length;
+
+        // ROM paths are relative to the manifest location
+        snprintf(directory, sizeof(directory), "%.*s", slash == NULL ? 0 : (int) (slash - manifest + 1), manifest);
+
+        manifestFile = fopen(manifest, "r");
+        if (manifestFile == NULL)
+        {
+                printf("Opening manifest %s returned error\n", manifest);
+                return CONST_NOK;
+        }
+
+        while (caseCount < CONST_MANIFEST_ENTRIES_MAX)
+        {
+                entry = &cases[caseCount];
+                if (fgets(entry->line, sizeof(entry->line), manifestFile) == NULL)
+                {
+                        break;
+                }
+                caseCount++;
+
+                entry->keys[0] = 0;
+                fields = sscanf(entry->line, "%255s %u %511s %63s", entry->rom, &entry->cycles, golden, entry->keys);
+                if (fields <= 0 || entry->rom[0] == CONST_MANIFEST_COMMENT)
+                {
+                        continue;
+                }
+                if (fields < 3)
+                {
+                        printf("Invalid manifest line: %s", entry->line);
+                        fclose(manifestFile);
+                        return CONST_NOK;
+                }
+
+                entry->isEntry = 1;
+                entry->hasGolden = strcmp(golden, CONST_MANIFEST_NO_GOLDEN) != 0;
+                entry->golden = strtoull(golden, NULL, 16);
+                length = entry->rom[0] == '/' ? 0 : strlen(directory);
+                memcpy(entry->path, directory, length);
+                memcpy(entry->path + length, entry->rom, strlen(entry->rom) + 1);
+        }
+
+        // Reading one more line tells a manifest of exactly CONST_MANIFEST_ENTRIES_MAX lines from a longer one
+        if (caseCount == CONST_MANIFEST_ENTRIES_MAX && fgets(golden, sizeof(golden), manifestFile) != NULL)
+        {
+                printf("Manifest has more than %d lines\n", CONST_MANIFEST_ENTRIES_MAX);
+                fclose(manifestFile);
+                return CONST_NOK;
+        }
+        fclose(manifestFile);
+
+        return CONST_OK;
+}
+
+/* Rewrites the manifest with the new golden hashes, keeping the comments */
+static __uint8_t write_manifest(const char *manifest)
+{
+        FILE *manifestFile = fopen(manifest, "w");
+        __uint16_t idx;
+
+        if (manifestFile == NULL)
+        {
+                printf("Opening manifest %s returned error\n", manifest);
+                return CONST_NOK;
+        }
+
+        for (idx = 0; idx < caseCount; idx++)
+        {
+                // Lines of ROMs that could not run keep their old golden hash
+                if (!cases[idx].isEntry || cases[idx].result.status != CONST_OK)
+                {
+                        fputs(cases[idx].line, manifestFile);
+                        continue;
+                }
+                fprintf(manifestFile, "%s %u %016" PRIx64 "%s%s\n", cases[idx].rom, cases[idx].cycles, cases[idx].result.hash,
+                        cases[idx].keys[0] != 0 ? " " : "", cases[idx].keys);
+        }
+
+        if (fclose(manifestFile) != 0)
+        {
+                printf("Closing file %s returned error\n", manifest);
+                return CONST_NOK;
+        }
+
+        return CONST_OK;
+}
+
+/* Saves the framebuffer next to the ROM, one text line per display row */
+static void write_golden_display(const struct conformancecase *entry)
+{
+        char name[(CONST_MANIFEST_PATH_SIZE << 1) + sizeof(CONST_GOLDEN_SUFFIX)];
+        FILE *goldenFile;
+        __uint8_t line;
+
+        snprintf(name, sizeof(name), "%s%s", entry->path, CONST_GOLDEN_SUFFIX);
+        goldenFile = fopen(name, "w");
+        if (goldenFile == NULL)
+        {
+                printf("Opening golden file %s returned error\n", name);
+                return;
+        }
+        for (line = 0; line < CONST_DISPLAY_SIZE_Y; line++)
+        {
+                fprintf(goldenFile, "%016" PRIx64 "\n", entry->result.display[line]);
+        }
+        fclose(goldenFile);
+}
+
+/* Prints the framebuffer against the golden one saved next to the ROM, marking the differing pixels */
+static void print_display_diff(const struct conformancecase *entry)
+{
+        char name[(CONST_MANIFEST_PATH_SIZE << 1) + sizeof(CONST_GOLDEN_SUFFIX)];
+        __uint64_t golden[CONST_DISPLAY_SIZE_Y], actual, expected;
+        FILE *goldenFile;
+        __uint8_t line, idx;
+
+        snprintf(name, sizeof(name), "%s%s", entry->path, CONST_GOLDEN_SUFFIX);
+        goldenFile = fopen(name, "r");
+        if (goldenFile == NULL)
+        {
+                printf("No golden framebuffer %s to compare with\n", name);
+                return;
+        }
+        for (line = 0; line < CONST_DISPLAY_SIZE_Y; line++)
+        {
+                if (fscanf(goldenFile, "%" SCNx64, &golden[line]) != 1)
+                {
+                        printf("Golden framebuffer %s is truncated\n", name);
+                        fclose(goldenFile);
+                        return;
+                }
+        }
+        fclose(goldenFile);
+
+        printf("Framebuffer diff (%c only in result, %c only in golden):\n", CONST_DIFF_CHARACTER_ADDED, CONST_DIFF_CHARACTER_REMOVED);
+        for (line = 0; line < CONST_DISPLAY_SIZE_Y; line++)
+        {
+                for (idx = CONST_DISPLAY_SIZE_X; idx > 0; idx--)
+                {
+                        actual = (entry->result.display[line] >> (idx - 1)) & 1;
+                        expected = (golden[line] >> (idx - 1)) & 1;
+                        if (actual == expected)
+                        {
+                                putchar(actual ? CONST_DISPLAY_CHARACTER_SET : CONST_DISPLAY_CHARACTER_UNSET);
+                        }
+                        else
+                        {
+                                putchar(actual ? CONST_DIFF_CHARACTER_ADDED : CONST_DIFF_CHARACTER_REMOVED);
+                        }
+                }
+                printf("|\n");
+        }
+}
+
+/* Starts a worker process running the ROM, the result comes back through a pipe */
+static __uint8_t start_worker(struct conformancecase *entry)
+{
+        int fds[2];
+
+        if (pipe(fds) != 0)
+        {
+                printf("Creating a pipe returned error\n");
+                return CONST_NOK;
+        }
+
+        // Anything buffered would get printed again by the worker
+        fflush(stdout);
+        entry->pid = fork();
+        if (entry->pid < 0)
+        {
+                printf("Starting a worker returned error\n");
+                close(fds[0]);
+                close(fds[1]);
+                return CONST_NOK;
+        }
+
+        if (entry->pid == 0)
+        {
+                struct conformanceresult result;
+
+                close(fds[0]);
+                run_rom(entry, &result);
+                fflush(stdout);
+                // The result is smaller than the pipe buffer, so this never blocks
+                _exit(write(fds[1], &result, sizeof(result)) == sizeof(result) ? CONST_OK : CONST_NOK);
+        }
+
+        close(fds[1]);
+        entry->pipeFd = fds[0];
+
+        return CONST_OK;
+}
+
+/* Waits for any worker to finish and collects its result */
+static void wait_worker(void)
+{
+        pid_t pid = wait(NULL);
+        __uint16_t idx;
+
+        for (idx = 0; idx < caseCount; idx++)
+        {
+                if (cases[idx].isEntry && cases[idx].pid == pid)
+                {
+                        if (read(cases[idx].pipeFd, &cases[idx].result, sizeof(struct conformanceresult)) != sizeof(struct conformanceresult))
+                        {
+                                cases[idx].result.status = CONST_NOK;
+                        }
+                        close(cases[idx].pipeFd);
+                        return;
+                }
+        }
+}
+
+int main(int argc, char **argv)
+{
+        /* Parsing program arguments */
+        if (argc < CONST_ARGC_MIN || argc > CONST_ARGC_MAX || (argc == CONST_ARGC_MAX && strcmp(argv[2], CONST_UPDATE_FLAG) != 0))
+        {
+                printf("Usage: %s <manifest> [%s]\n", argv[0], CONST_UPDATE_FLAG);
+                return CONST_NOK;
+        }
+        __uint8_t update = argc == CONST_ARGC_MAX;
+
+        if (read_manifest(argv[1]) != CONST_OK)
+        {
+                return CONST_NOK;
+        }
+
+
+
+        /* Running every ROM, one worker per core */
+        long workers = sysconf(_SC_NPROCESSORS_ONLN);
+        long running = 0;
+        struct timespec start, end;
+        __uint16_t idx;
+
+        // The core count is unknown when sysconf() fails, run one ROM at a time then
+        if (workers < 1)
+        {
+                workers = 1;
+        }
+        verbose = 0;
+        keyboard_input = conformance_keyboard_input;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        for (idx = 0; idx < caseCount; idx++)
+        {
+                if (!cases[idx].isEntry)
+                {
+                        continue;
+                }
+                if (running >= workers)
+                {
+                        wait_worker();
+                        running--;
+                }
+                if (start_worker(&cases[idx]) != CONST_OK)
+                {
+                        cases[idx].result.status = CONST_NOK;
+                        continue;
+                }
+                running++;
+        }
+        for (; running > 0; running--)
+        {
+                wait_worker();
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+
+
+        /* Comparing against the golden values */
+        __uint16_t total = 0, failed = 0;
+
+        for (idx = 0; idx < caseCount; idx++)
+        {
+                struct conformancecase *entry = &cases[idx];
+
+                if (!entry->isEntry)
+                {
+                        continue;
+                }
+                total++;
+
+                if (entry->result.status != CONST_OK)
+                {
+                        printf("[ERROR] %s\n", entry->rom);
+                        failed++;
+                }
+                else if (update)
+                {
+                        printf("[UPDATED] %s %016" PRIx64 "\n", entry->rom, entry->result.hash);
+                        write_golden_display(entry);
+                }
+                else if (!entry->hasGolden)
+                {
+                        printf("[NO GOLDEN] %s %016" PRIx64 "\n", entry->rom, entry->result.hash);
+                        failed++;
+                }
+                else if (entry->result.hash != entry->golden)
+                {
+                        printf("[MISMATCH] %s %016" PRIx64 ", expected %016" PRIx64 "\n", entry->rom, entry->result.hash, entry->golden);
+                        print_display_diff(entry);
+                        failed++;
+                }
+                else
+                {
+                        printf("[OK] %s\n", entry->rom);
+                }
+        }
+
+        printf("Ran %u ROMs in %.3f s on %ld cores, %u failed\n", total,
+               (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9, workers, failed);
+
+        if (update && write_manifest(argv[1]) != CONST_OK)
+        {
+                return CONST_NOK;
+        }
+
+        return failed == 0 ? CONST_OK : CONST_NOK;
+}
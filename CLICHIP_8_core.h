@@ -0,0 +1,121 @@
+#ifndef CLICHIP_8_CORE_H
+#define CLICHIP_8_CORE_H
+
+#include <stdio.h>
+
+
+
+
+
+/* Constant values */
+#define CONST_OK 0
+#define CONST_NOK 1
+
+/**
+ * @brief Most commonly the machines had 4096 (0x1000) bytes.
+ * The CHIP-8 interpreter would be from 0 (0x000) to 511(0x1FF) bytes.
+ * The program starts after the first 512 (0x200) bytes. Probably continues up until (0xE99). Total length of 3225 bytes.
+ * The last 256 bytes (0xF00 - 0xFFF) are reserved for display refresh.
+ * The 96 bytes below that (0xEA0 - 0xEFF), are reserved for the stack and other variables.
+ */
+#define CONST_MEMORY_SIZE_TOTAL (1 << 12)  // 4096 bytes
+#define CONST_MEMORY_START_PROGRAM 0x200
+#define CONST_MEMORY_START_RESERVED 0xEA0
+#define CONST_MEMORY_START_STACK CONST_MEMORY_START_RESERVED
+#define CONST_MEMORY_END_PROGRAM (CONST_MEMORY_START_RESERVED - 1)
+#define CONST_MEMORY_END_RESERVED 0xF00
+#define CONST_MEMORY_END_STACK CONST_MEMORY_END_RESERVED
+#define CONST_MEMORY_SIZE_PROGRAM (CONST_MEMORY_END_PROGRAM - CONST_MEMORY_START_PROGRAM)
+#define CONST_MEMORY_STACK_NESTING_LIMIT 12
+// Last byte from the reserved memory area will be used as a stack counter, unless there is some better way of doing it
+#define CONST_MEMORY_STACK_COUNTER_POS (CONST_MEMORY_END_RESERVED - 1)
+// Memory is split in 256-byte pages for tracking which parts were written to
+#define CONST_MEMORY_PAGE_POSITION 8
+#define CONST_MEMORY_PAGE_SIZE (1 << CONST_MEMORY_PAGE_POSITION)
+#define CONST_MEMORY_PAGE_MASK ((CONST_MEMORY_SIZE_TOTAL >> CONST_MEMORY_PAGE_POSITION) - 1)
+// Addresses running past the end of the memory wrap around to the start.
+// With the mirrored memory the same 4096 bytes are mapped twice back to back, so any address below 0x2000 wraps without masking.
+#ifdef CLICHIP_8_MIRRORED_MEMORY
+#define MEM_ADDRESS(address) (address)
+#else
+#define MEM_ADDRESS(address) ((address) & (CONST_MEMORY_SIZE_TOTAL - 1))
+#endif
+
+#define CONST_DISPLAY_SIZE_X 64
+// Formatting with a delimiter column and newline
+#define CONST_DISPLAY_SIZE_X_WITH_FORMATTING (CONST_DISPLAY_SIZE_X + 2)
+#define CONST_DISPLAY_SIZE_Y 32
+// Formatting with two delimiter lines
+#define CONST_DISPLAY_SIZE_Y_WITH_FORMATTING (CONST_DISPLAY_SIZE_Y + 2)
+#define CONST_DISPLAY_SIZE_BUFFER (CONST_DISPLAY_SIZE_X_WITH_FORMATTING * CONST_DISPLAY_SIZE_Y_WITH_FORMATTING)
+#define CONST_DISPLAY_CHARACTER_SET '#'
+#define CONST_DISPLAY_CHARACTER_UNSET ' '
+
+#define CONST_REGISTERS_COUNT 16  // Amount of 8-bit registers
+#define CONST_OPCODE_POSITION 12  // Instructions are 2 bytes long, we want the 4 most significant bits from 2 bytes
+#define CONST_OPCODE_ADDRESS_MASK 0x0FFF  // Mask used to get the 12-bit address from instructions
+#define CONST_OPCODE_DATA_MASK 0x00FF  // Mask used to get the 8-bit data value
+#define CONST_OPCODE_REGISTER_MASK 0x000F  // Mask used to get the 4-bit register index
+#define CONST_OPCODE_REGISTER_X_OFFSET 8  // Offset of bits from the LSB of instructions to reach register X
+#define CONST_OPCODE_REGISTER_Y_OFFSET 4  // Offset of bits from the LSB of instructions to reach register Y
+#define CONST_REGISTERS_IR_INCREMENT 2  // Amount of bytes jumped over by the PC after an instruction execution
+#define CONST_REGISTERS_IR_SKIP (CONST_REGISTERS_IR_INCREMENT << 1)  // Amount of bytes jumped over by the PC after the next instruction gets skipped
+#define CONST_REGISTERS_VF_INDEX 0xF
+#define CONST_REGISTERS_MAXVALUE 0xFFFF
+#define CONST_REGISTERS_MSB_POSITION 15
+#define CONST_REGISTERS_MSB_MASK (1 << CONST_REGISTERS_MSB_POSITION)
+
+
+
+
+/* Data structures */
+/* struct hwregs - represents the individual registers */
+struct hwregs
+{
+        __uint8_t regV[CONST_REGISTERS_COUNT];
+        __uint16_t regI;  // Address register
+};
+
+/* struct hwstate - represents the memory, registers and other resources */
+struct hwstate
+{
+        __uint8_t *mem;  // CONST_MEMORY_SIZE_TOTAL bytes, set up by setup_memory()
+        // Display color is monochrome, 64 pixels width with 32 pixels height
+        __uint64_t display[CONST_DISPLAY_SIZE_Y];
+        struct hwregs regs;
+        __uint16_t PC;
+};
+
+/* struct hwdirty - tracks which parts of the state were written to, so they can be restored without touching the rest */
+struct hwdirty
+{
+        __uint16_t pages;  // One bit per 256-byte memory page
+        __uint32_t rows;  // One bit per display row
+};
+
+
+
+
+/* Shared state */
+extern struct hwstate state;
+extern struct hwdirty dirty;
+// Set to 0 to silence the instruction trace and the display printing
+extern __uint8_t verbose;
+// Source of the hex keyboard digits, defaults to get_keyboard_input()
+extern __uint8_t (*keyboard_input)(void);
+// Source of the CXNN random numbers, defaults to get_random_number()
+extern __uint8_t (*random_number)(void);
+
+
+
+
+/* Functions */
+__uint8_t setup_memory(void);
+__uint8_t get_keyboard_input(void);
+__uint8_t get_random_number(void);
+void print_display(void);
+void draw(__uint8_t pos_x, __uint8_t pos_y, __uint8_t n);
+void execute_instruction(void);
+void setup_fonts(void);
+
+#endif
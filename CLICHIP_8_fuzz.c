@@ -0,0 +1,445 @@
+#include "CLICHIP_8_core.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+
+
+
+/* Constant values */
+#define CONST_ARGC_MIN 2
+#define CONST_ARGC_MAX 5
+#define CONST_FUZZ_ITERATIONS_DEFAULT 10000000
+#define CONST_FUZZ_CYCLES_DEFAULT 1000  // Cycle budget for a single case
+#define CONST_FUZZ_REPORT_INTERVAL (1 << 18)  // Amount of cases between two status reports
+#define CONST_FUZZ_CXNN_SEED 0x2545F491  // CXNN random state at the start of every case, so a saved case replays the same numbers
+
+#define CONST_FUZZ_PATCHES_MAX 64  // Maximum amount of byte changes a case carries over the seed ROM
+#define CONST_FUZZ_MUTATIONS_MAX 4  // Maximum amount of new byte changes per case
+#define CONST_FUZZ_INPUT_LENGTH 16  // Length of the hex keyboard input sequence of a case
+#define CONST_FUZZ_CORPUS_LIMIT 1024
+
+// PC bitmap has one bit per memory address, edge bitmap one bit per hashed (previous, current) instruction pair
+#define CONST_FUZZ_PC_MAP_SIZE (CONST_MEMORY_SIZE_TOTAL >> 3)
+#define CONST_FUZZ_EDGE_MAP_BITS 16
+#define CONST_FUZZ_EDGE_MAP_SIZE ((1 << CONST_FUZZ_EDGE_MAP_BITS) >> 3)
+#define CONST_FUZZ_EDGE_MAP_MASK ((1 << CONST_FUZZ_EDGE_MAP_BITS) - 1)
+
+#define CONST_FAULT_NONE 0
+#define CONST_FAULT_PC 1  // PC points outside of the memory
+#define CONST_FAULT_MEMORY 2  // I plus the offset runs past the memory in draw(), FX33, FX55 or FX65
+#define CONST_FAULT_DISPLAY 3  // Sprite rows run past the display in draw()
+#define CONST_FAULT_STACK 4  // Stack counter over CONST_MEMORY_STACK_NESTING_LIMIT
+#define CONST_FAULT_OPCODE 5  // Undefined opcode
+#define CONST_FAULT_HANG 6  // PC no longer advancing
+#define CONST_FAULT_COUNT 7
+
+
+
+
+/* Data structures */
+/* struct fuzzcase - a ROM stored as byte changes over the seed ROM, plus the keyboard input sequence */
+struct fuzzcase
+{
+        __uint16_t offset[CONST_FUZZ_PATCHES_MAX];
+        __uint8_t value[CONST_FUZZ_PATCHES_MAX];
+        __uint8_t patches;
+        __uint8_t input[CONST_FUZZ_INPUT_LENGTH];
+};
+
+static const char *fault_names[CONST_FAULT_COUNT] = {"none", "pc", "memory", "display", "stack", "opcode", "hang"};
+
+// State right after loading the seed ROM, dirty parts get restored from it between cases
+static struct hwstate snapshot;
+static __uint8_t snapshotMem[CONST_MEMORY_SIZE_TOTAL];
+static __uint16_t seedLength;
+
+static struct fuzzcase corpus[CONST_FUZZ_CORPUS_LIMIT];
+static __uint16_t corpusSize;
+static struct fuzzcase current;
+static __uint8_t inputPos;
+
+static __uint8_t pcMap[CONST_FUZZ_PC_MAP_SIZE];
+static __uint8_t edgeMap[CONST_FUZZ_EDGE_MAP_SIZE];
+static __uint32_t pcCount, edgeCount;
+static __uint64_t faultCount[CONST_FAULT_COUNT];
+
+static __uint64_t rngState;
+static __uint32_t cxnnState;
+
+
+
+
+/* Functions */
+/* xorshift64, rand() is too slow and too short for picking mutations */
+static inline __uint64_t next_random(void)
+{
+        rngState ^= rngState << 13;
+        rngState ^= rngState >> 7;
+        rngState ^= rngState << 17;
+        return rngState;
+}
+
+/* xorshift32 for CXNN, resetting one word per case is much cheaper than srand() */
+static __uint8_t fuzz_random_number(void)
+{
+        cxnnState ^= cxnnState << 13;
+        cxnnState ^= cxnnState >> 17;
+        cxnnState ^= cxnnState << 5;
+        return (__uint8_t) cxnnState;
+}
+
+/* Feeds the keyboard input sequence of the current case instead of reading stdin */
+static __uint8_t fuzz_keyboard_input(void)
+{
+        return current.input[inputPos++ % CONST_FUZZ_INPUT_LENGTH] & CONST_OPCODE_REGISTER_MASK;
+}
+
+/* Restores only the memory pages and display rows written to since the snapshot */
+static void restore_snapshot(void)
+{
+        __uint8_t idx;
+
+        while (dirty.pages != 0)
+        {
+                idx = __builtin_ctz(dirty.pages);
+                memcpy(state.mem + (idx << CONST_MEMORY_PAGE_POSITION), snapshotMem + (idx << CONST_MEMORY_PAGE_POSITION), CONST_MEMORY_PAGE_SIZE);
+                dirty.pages &= dirty.pages - 1;
+        }
+        while (dirty.rows != 0)
+        {
+                idx = __builtin_ctz(dirty.rows);
+                state.display[idx] = snapshot.display[idx];
+                dirty.rows &= dirty.rows - 1;
+        }
+
+        state.regs = snapshot.regs;
+        state.PC = snapshot.PC;
+}
+
+/* Derives a new case from a corpus entry by changing a few ROM bytes and the input sequence */
+static void mutate_case(const struct fuzzcase *parent)
+{
+        __uint8_t idx, mutations, pos;
+
+        current = *parent;
+        mutations = 1 + next_random() % CONST_FUZZ_MUTATIONS_MAX;
+        for (idx = 0; idx < mutations; idx++)
+        {
+                __uint64_t random = next_random();
+
+                // Add a new change while there is room, otherwise overwrite an existing one
+                pos = current.patches < CONST_FUZZ_PATCHES_MAX ? current.patches++ : random % CONST_FUZZ_PATCHES_MAX;
+                current.offset[pos] = CONST_MEMORY_START_PROGRAM + (random >> 8) % seedLength;
+                switch ((random >> 32) & 3)
+                {
+                        case 0:
+                                // Flip a single bit
+                                current.value[pos] = snapshotMem[current.offset[pos]] ^ (1 << ((random >> 40) & 7));
+                                break;
+                        case 1:
+                                // Swap the opcode nibble
+                                current.value[pos] = (snapshotMem[current.offset[pos]] & 0x0F) | ((random >> 40) & 0xF0);
+                                break;
+                        default:
+                                // Random byte
+                                current.value[pos] = (__uint8_t) (random >> 40);
+                }
+        }
+
+        if ((next_random() & 7) == 0)
+        {
+                current.input[next_random() % CONST_FUZZ_INPUT_LENGTH] = (__uint8_t) next_random();
+        }
+}
+
+/* Writes the case ROM into memory, marking the changed pages as dirty */
+static void load_case(void)
+{
+        __uint8_t idx;
+
+        for (idx = 0; idx < current.patches; idx++)
+        {
+                state.mem[current.offset[idx]] = current.value[idx];
+                dirty.pages |= 1 << (current.offset[idx] >> CONST_MEMORY_PAGE_POSITION);
+        }
+        inputPos = 0;
+}
+
+/* Sets the bit in a coverage bitmap, returns 1 if it was not set before */
+static inline __uint8_t cover(__uint8_t *map, __uint32_t bit)
+{
+        __uint8_t mask = 1 << (bit & 7);
+
+        if ((map[bit >> 3] & mask) == 0)
+        {
+                map[bit >> 3] |= mask;
+                return 1;
+        }
+        return 0;
+}
+
+/* Checks the instruction at PC for anything a well-formed ROM would not do, like relying on address wraparound, without executing it */
+static __uint8_t check_instruction(__uint16_t instruction)
+{
+        __uint8_t regX = (instruction >> CONST_OPCODE_REGISTER_X_OFFSET) & CONST_OPCODE_REGISTER_MASK;
+        __uint8_t regY = (instruction >> CONST_OPCODE_REGISTER_Y_OFFSET) & CONST_OPCODE_REGISTER_MASK;
+        __uint8_t counter = state.mem[CONST_MEMORY_STACK_COUNTER_POS];
+
+        switch (instruction >> CONST_OPCODE_POSITION)
+        {
+                case 0x0:
+                        if ((instruction & CONST_OPCODE_ADDRESS_MASK) == 0x00EE && counter > CONST_MEMORY_STACK_NESTING_LIMIT)
+                        {
+                                return CONST_FAULT_STACK;
+                        }
+                        break;
+                case 0x2:
+                        if (counter >= CONST_MEMORY_STACK_NESTING_LIMIT)
+                        {
+                                return CONST_FAULT_STACK;
+                        }
+                        break;
+                case 0x5:
+                case 0x9:
+                        if ((instruction & 0x000F) != 0)
+                        {
+                                return CONST_FAULT_OPCODE;
+                        }
+                        break;
+                case 0x8:
+                        if ((instruction & 0x000F) > 0x0007 && (instruction & 0x000F) != 0x000E)
+                        {
+                                return CONST_FAULT_OPCODE;
+                        }
+                        break;
+                case 0xD:
+                        if (state.regs.regI + (instruction & 0x000F) > CONST_MEMORY_SIZE_TOTAL)
+                        {
+                                return CONST_FAULT_MEMORY;
+                        }
+                        if (state.regs.regV[regY] + (instruction & 0x000F) > CONST_DISPLAY_SIZE_Y)
+                        {
+                                return CONST_FAULT_DISPLAY;
+                        }
+                        break;
+                case 0xE:
+                        if ((instruction & 0x00FF) != 0x009E && (instruction & 0x00FF) != 0x00A1)
+                        {
+                                return CONST_FAULT_OPCODE;
+                        }
+                        break;
+                case 0xF:
+                        switch (instruction & 0x00FF)
+                        {
+                                case 0x0007:
+                                case 0x000A:
+                                case 0x0015:
+                                case 0x0018:
+                                case 0x001E:
+                                case 0x0029:
+                                        break;
+                                case 0x0033:
+                                        if (state.regs.regI + 3 > CONST_MEMORY_SIZE_TOTAL)
+                                        {
+                                                return CONST_FAULT_MEMORY;
+                                        }
+                                        break;
+                                case 0x0055:
+                                case 0x0065:
+                                        if (state.regs.regI + regX + 1 > CONST_MEMORY_SIZE_TOTAL)
+                                        {
+                                                return CONST_FAULT_MEMORY;
+                                        }
+                                        break;
+                                default:
+                                        return CONST_FAULT_OPCODE;
+                        }
+                        break;
+        }
+
+        return CONST_FAULT_NONE;
+}
+
+/* Runs the loaded case for up to cycles instructions, returns the fault and sets new_coverage when new bits were hit */
+static __uint8_t run_case(__uint32_t cycles, __uint8_t *new_coverage)
+{
+        __uint16_t instruction, location, previous = 0, oldPC;
+        __uint8_t fault;
+
+        for (; cycles > 0; cycles--)
+        {
+                if (state.PC > CONST_MEMORY_SIZE_TOTAL - CONST_REGISTERS_IR_INCREMENT)
+                {
+                        return CONST_FAULT_PC;
+                }
+
+                instruction = (state.mem[state.PC] << 8) | state.mem[state.PC + 1];
+                location = state.PC ^ (instruction & ~CONST_OPCODE_ADDRESS_MASK);
+                if (cover(pcMap, state.PC))
+                {
+                        pcCount++;
+                        *new_coverage = 1;
+                }
+                if (cover(edgeMap, ((previous >> 1) ^ location) & CONST_FUZZ_EDGE_MAP_MASK))
+                {
+                        edgeCount++;
+                        *new_coverage = 1;
+                }
+                previous = location;
+
+                fault = check_instruction(instruction);
+                if (fault != CONST_FAULT_NONE)
+                {
+                        return fault;
+                }
+
+                oldPC = state.PC;
+                execute_instruction();
+                if (state.PC == oldPC)
+                {
+                        // Jumping to itself is the usual way for a program to halt
+                        return instruction == (0x1000 | oldPC) ? CONST_FAULT_NONE : CONST_FAULT_HANG;
+                }
+        }
+
+        return CONST_FAULT_NONE;
+}
+
+/* Saves the ROM of the current case, named after the fault */
+static void save_case(__uint8_t fault)
+{
+        __uint8_t rom[CONST_MEMORY_SIZE_PROGRAM];
+        char name[32];
+        FILE *outputFile;
+        __uint8_t idx;
+
+        memcpy(rom, snapshotMem + CONST_MEMORY_START_PROGRAM, seedLength);
+        for (idx = 0; idx < current.patches; idx++)
+        {
+                rom[current.offset[idx] - CONST_MEMORY_START_PROGRAM] = current.value[idx];
+        }
+
+        snprintf(name, sizeof(name), "fuzz_%s.ch8", fault_names[fault]);
+        outputFile = fopen(name, "wb");
+        if (outputFile == NULL)
+        {
+                printf("Opening output file %s returned error\n", name);
+                return;
+        }
+        fwrite(rom, 1, seedLength, outputFile);
+        if (fclose(outputFile) != 0)
+        {
+                printf("Closing file %s returned error\n", name);
+        }
+}
+
+/* Prints the current execution speed, coverage and fault counts */
+static void print_status(__uint64_t iteration, clock_t start)
+{
+        double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+        __uint8_t fault;
+
+        printf("[%" PRIu64 "] %.0f execs/s, corpus %u, pc %u, edges %u, faults:", iteration, seconds > 0 ? iteration / seconds : 0, corpusSize, pcCount, edgeCount);
+        for (fault = CONST_FAULT_NONE + 1; fault < CONST_FAULT_COUNT; fault++)
+        {
+                printf(" %s %" PRIu64, fault_names[fault], faultCount[fault]);
+        }
+        printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+        /* Parsing program arguments */
+        if (argc < CONST_ARGC_MIN || argc > CONST_ARGC_MAX)
+        {
+                printf("Usage: %s <seed ROM> [iterations] [cycles per case] [random seed]\n", argv[0]);
+                return CONST_NOK;
+        }
+
+        FILE *inputFile = fopen(argv[1], "rb");
+        if (inputFile == NULL)
+        {
+                printf("Opening input file %s returned error\n", argv[1]);
+                return CONST_NOK;
+        }
+
+        __uint64_t iterations = argc > 2 ? strtoull(argv[2], NULL, 0) : CONST_FUZZ_ITERATIONS_DEFAULT;
+        __uint32_t cycles = argc > 3 ? strtoul(argv[3], NULL, 0) : CONST_FUZZ_CYCLES_DEFAULT;
+        __uint64_t seed = argc > 4 ? strtoull(argv[4], NULL, 0) : (__uint64_t) time(NULL);
+
+
+
+        /* Loading the seed ROM and taking the snapshot */
+        verbose = 0;
+        keyboard_input = fuzz_keyboard_input;
+        random_number = fuzz_random_number;
+        // xorshift64 gets stuck on 0
+        rngState = seed | 1;
+        printf("Random seed %" PRIu64 "\n", seed);
+
+        memset(&state, 0, sizeof(struct hwstate));
+        if (setup_memory() != CONST_OK)
+        {
+                printf("Setting up the memory returned error\n");
+                return CONST_NOK;
+        }
+        state.PC = CONST_MEMORY_START_PROGRAM;
+        setup_fonts();
+        seedLength = (__uint16_t) fread(state.mem + CONST_MEMORY_START_PROGRAM, 1, CONST_MEMORY_SIZE_PROGRAM, inputFile);
+        if (fclose(inputFile) != 0)
+        {
+                printf("Closing file %s returned error\n", argv[1]);
+        }
+        if (seedLength == 0)
+        {
+                printf("Could not read any bytes\n");
+                return CONST_NOK;
+        }
+
+        snapshot = state;
+        memcpy(snapshotMem, state.mem, CONST_MEMORY_SIZE_TOTAL);
+        dirty.pages = 0;
+        dirty.rows = 0;
+        corpusSize = 1;
+
+
+
+        /* Fuzzing loop */
+        clock_t start = clock();
+        for (__uint64_t iteration = 1; iteration <= iterations; iteration++)
+        {
+                __uint8_t fault, new_coverage = 0;
+
+                mutate_case(&corpus[next_random() % corpusSize]);
+                load_case();
+                cxnnState = CONST_FUZZ_CXNN_SEED;
+                fault = run_case(cycles, &new_coverage);
+
+                if (fault != CONST_FAULT_NONE)
+                {
+                        if (faultCount[fault]++ == 0)
+                        {
+                                printf("[%" PRIu64 "] First %s fault at PC %03X, saved as fuzz_%s.ch8\n", iteration, fault_names[fault], state.PC, fault_names[fault]);
+                                save_case(fault);
+                        }
+                }
+                else if (new_coverage && corpusSize < CONST_FUZZ_CORPUS_LIMIT)
+                {
+                        corpus[corpusSize++] = current;
+                }
+
+                restore_snapshot();
+
+                if ((iteration % CONST_FUZZ_REPORT_INTERVAL) == 0)
+                {
+                        print_status(iteration, start);
+                }
+        }
+        print_status(iterations, start);
+
+        return CONST_OK;
+}
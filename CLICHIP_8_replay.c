@@ -0,0 +1,161 @@
+#include "CLICHIP_8_core.h"
+#include "CLICHIP_8_stream.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+
+
+
+/* Constant values */
+#define CONST_ARGC_MIN 2
+#define CONST_ARGC_MAX 3  // Optional PGM file name prefix
+#define CONST_PGM_PIXEL_SET 255
+#define CONST_PGM_PIXEL_UNSET 0
+#define CONST_PGM_NAME_SIZE 256
+#define CONST_FRAME_END 2  // read_frame() result for a stream that ended cleanly between frames
+
+
+
+
+/* Functions */
+/* Reads the next frame record and applies its row deltas to the display.
+ * Returns CONST_FRAME_END at the end of the stream and CONST_NOK for a truncated or invalid frame */
+static __uint8_t read_frame(FILE *inputFile, __uint32_t *number, __uint32_t *cycles)
+{
+        __uint8_t rows, row, idx;
+        __uint64_t delta;
+        int next;
+
+        // Only a stream with no bytes left after the previous frame ends cleanly
+        next = fgetc(inputFile);
+        if (next == EOF)
+        {
+                if (ferror(inputFile))
+                {
+                        printf("Reading the frame stream returned error\n");
+                        return CONST_NOK;
+                }
+                return CONST_FRAME_END;
+        }
+        ungetc(next, inputFile);
+
+        if (fread(number, sizeof(__uint32_t), 1, inputFile) != 1
+                || fread(cycles, sizeof(__uint32_t), 1, inputFile) != 1
+                || fread(&rows, sizeof(__uint8_t), 1, inputFile) != 1)
+        {
+                printf("Frame header is truncated\n");
+                return CONST_NOK;
+        }
+        if (rows > CONST_DISPLAY_SIZE_Y)
+        {
+                printf("Frame %u has invalid row count %u\n", *number, rows);
+                return CONST_NOK;
+        }
+
+        for (idx = 0; idx < rows; idx++)
+        {
+                if (fread(&row, sizeof(__uint8_t), 1, inputFile) != 1
+                        || fread(&delta, sizeof(__uint64_t), 1, inputFile) != 1)
+                {
+                        printf("Frame %u is truncated\n", *number);
+                        return CONST_NOK;
+                }
+                if (row >= CONST_DISPLAY_SIZE_Y)
+                {
+                        printf("Frame %u has invalid row %u\n", *number, row);
+                        return CONST_NOK;
+                }
+                state.display[row] ^= delta;
+        }
+
+        return CONST_OK;
+}
+
+/* Writes the display as a binary PGM image, the most significant bit of a row is the leftmost pixel */
+static void write_pgm(const char *prefix, __uint32_t number)
+{
+        __uint8_t pixels[CONST_DISPLAY_SIZE_Y][CONST_DISPLAY_SIZE_X];
+        char name[CONST_PGM_NAME_SIZE];
+        FILE *outputFile;
+        __uint8_t line, idx;
+
+        for (line = 0; line < CONST_DISPLAY_SIZE_Y; line++)
+        {
+                for (idx = 0; idx < CONST_DISPLAY_SIZE_X; idx++)
+                {
+                        pixels[line][CONST_DISPLAY_SIZE_X - idx - 1] = ((state.display[line] >> idx) & 1) ? CONST_PGM_PIXEL_SET : CONST_PGM_PIXEL_UNSET;
+                }
+        }
+
+        snprintf(name, sizeof(name), "%s%06u.pgm", prefix, number);
+        outputFile = fopen(name, "wb");
+        if (outputFile == NULL)
+        {
+                printf("Opening output file %s returned error\n", name);
+                return;
+        }
+        fprintf(outputFile, "P5\n%d %d\n%d\n", CONST_DISPLAY_SIZE_X, CONST_DISPLAY_SIZE_Y, CONST_PGM_PIXEL_SET);
+        fwrite(pixels, 1, sizeof(pixels), outputFile);
+        if (fclose(outputFile) != 0)
+        {
+                printf("Closing file %s returned error\n", name);
+        }
+}
+
+int main(int argc, char **argv)
+{
+        /* Parsing program arguments */
+        if (argc < CONST_ARGC_MIN || argc > CONST_ARGC_MAX)
+        {
+                printf("Usage: %s <frame stream> [PGM file name prefix]\n", argv[0]);
+                return CONST_NOK;
+        }
+
+        FILE *inputFile = fopen(argv[1], "rb");
+        if (inputFile == NULL)
+        {
+                printf("Opening input file %s returned error\n", argv[1]);
+                return CONST_NOK;
+        }
+
+        char magic[CONST_STREAM_MAGIC_SIZE];
+        if (fread(magic, 1, CONST_STREAM_MAGIC_SIZE, inputFile) != CONST_STREAM_MAGIC_SIZE
+                || memcmp(magic, CONST_STREAM_MAGIC, CONST_STREAM_MAGIC_SIZE) != 0)
+        {
+                printf("Input file %s is not a frame stream\n", argv[1]);
+                fclose(inputFile);
+                return CONST_NOK;
+        }
+
+
+
+        /* Replaying the frames */
+        __uint32_t number, cycles;
+        __uint8_t result;
+
+        memset(&state, 0, sizeof(struct hwstate));
+        while ((result = read_frame(inputFile, &number, &cycles)) == CONST_OK)
+        {
+                if (argc == CONST_ARGC_MAX)
+                {
+                        write_pgm(argv[2], number);
+                }
+                else
+                {
+                        printf("Frame %u at cycle %u", number, cycles);
+                        print_display();
+                }
+        }
+
+
+
+        /* cleaning memory and exiting */
+        if (fclose(inputFile) != 0)
+        {
+                printf("Closing file %s returned error\n", argv[1]);
+        }
+
+        return (result == CONST_FRAME_END) ? CONST_OK : CONST_NOK;
+}
@@ -0,0 +1,185 @@
+#include "CLICHIP_8_stream.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+
+
+
+
+/* Constant values */
+#define CONST_STREAM_HEADER_IOVECS 3  // Frame number, cycle count and row count
+#define CONST_STREAM_ROW_IOVECS 2  // Row index and XOR delta
+#define CONST_STREAM_IOVECS (CONST_STREAM_BATCH_FRAMES * (CONST_STREAM_HEADER_IOVECS + CONST_STREAM_ROW_IOVECS * CONST_DISPLAY_SIZE_Y))
+#define CONST_STREAM_FILE_MODE 0644
+
+
+
+
+/* Data structures */
+/* struct framebatch - frames waiting to be written, the iovecs point straight into the other fields */
+static struct framebatch
+{
+        __uint32_t number[CONST_STREAM_BATCH_FRAMES];
+        __uint32_t cycles[CONST_STREAM_BATCH_FRAMES];
+        __uint8_t rows[CONST_STREAM_BATCH_FRAMES];
+        __uint64_t delta[CONST_STREAM_BATCH_FRAMES][CONST_DISPLAY_SIZE_Y];
+        struct iovec iov[CONST_STREAM_IOVECS];
+        int iovCount;
+        __uint8_t frames;
+} batch;
+
+// Row indexes never change, so every record can point at the same bytes
+static const __uint8_t rowIndex[CONST_DISPLAY_SIZE_Y] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                                                        16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31};
+
+// Display as of the last streamed frame
+static __uint64_t previous[CONST_DISPLAY_SIZE_Y];
+static __uint32_t frameCount;
+static int streamFd = -1;
+
+
+
+
+/* Functions */
+/* Appends one iovec to the batch */
+static inline void add_iovec(const void *base, size_t length)
+{
+        batch.iov[batch.iovCount].iov_base = (void *) base;
+        batch.iov[batch.iovCount].iov_len = length;
+        batch.iovCount++;
+}
+
+/* Writes all the batched frames with writev(), resuming after partial writes */
+static __uint8_t stream_flush(void)
+{
+        struct iovec *iov = batch.iov;
+        int remaining = batch.iovCount;
+        ssize_t written;
+
+        while (remaining > 0)
+        {
+                written = writev(streamFd, iov, remaining);
+                if (written < 0)
+                {
+                        if (errno == EINTR)
+                        {
+                                continue;
+                        }
+                        printf("Writing the frame stream returned error\n");
+                        // Drop the batch, so closing the stream does not try to write it again
+                        batch.iovCount = 0;
+                        batch.frames = 0;
+                        return CONST_NOK;
+                }
+
+                // Skip the fully written iovecs and trim the partially written one
+                while (remaining > 0 && (size_t) written >= iov->iov_len)
+                {
+                        written -= iov->iov_len;
+                        iov++;
+                        remaining--;
+                }
+                if (remaining > 0)
+                {
+                        iov->iov_base = (__uint8_t *) iov->iov_base + written;
+                        iov->iov_len -= written;
+                }
+        }
+
+        batch.iovCount = 0;
+        batch.frames = 0;
+
+        return CONST_OK;
+}
+
+/* Opens the frame stream on a file or a named pipe */
+__uint8_t stream_open(const char *path)
+{
+        // A reader closing the pipe should surface as EPIPE from writev(), not kill the emulator
+        signal(SIGPIPE, SIG_IGN);
+
+        streamFd = open(path, O_WRONLY | O_CREAT | O_TRUNC, CONST_STREAM_FILE_MODE);
+        if (streamFd < 0)
+        {
+                printf("Opening frame stream %s returned error\n", path);
+                return CONST_NOK;
+        }
+
+        memset(previous, 0, sizeof(previous));
+        frameCount = 0;
+        add_iovec(CONST_STREAM_MAGIC, CONST_STREAM_MAGIC_SIZE);
+
+        return stream_flush();
+}
+
+/* Queues a frame with the display rows changed since the last one, consuming the dirty rows */
+__uint8_t stream_frame(__uint32_t cycles)
+{
+        __uint8_t slot = batch.frames, row, changed = 0;
+        int headerIov = batch.iovCount;
+
+        if (dirty.rows == 0)
+        {
+                return CONST_OK;
+        }
+
+        batch.number[slot] = frameCount + 1;
+        batch.cycles[slot] = cycles;
+        add_iovec(&batch.number[slot], sizeof(__uint32_t));
+        add_iovec(&batch.cycles[slot], sizeof(__uint32_t));
+        add_iovec(&batch.rows[slot], sizeof(__uint8_t));
+
+        while (dirty.rows != 0)
+        {
+                row = __builtin_ctz(dirty.rows);
+                dirty.rows &= dirty.rows - 1;
+
+                // Rows drawn over with no visible change are left out
+                batch.delta[slot][changed] = state.display[row] ^ previous[row];
+                if (batch.delta[slot][changed] != 0)
+                {
+                        previous[row] = state.display[row];
+                        add_iovec(&rowIndex[row], sizeof(__uint8_t));
+                        add_iovec(&batch.delta[slot][changed], sizeof(__uint64_t));
+                        changed++;
+                }
+        }
+
+        if (changed == 0)
+        {
+                // Nothing visible changed, drop the frame
+                batch.iovCount = headerIov;
+                return CONST_OK;
+        }
+
+        batch.rows[slot] = changed;
+        batch.frames++;
+        frameCount++;
+
+        if (batch.frames == CONST_STREAM_BATCH_FRAMES)
+        {
+                return stream_flush();
+        }
+
+        return CONST_OK;
+}
+
+/* Writes the remaining frames and closes the frame stream */
+__uint8_t stream_close(void)
+{
+        __uint8_t result = stream_flush();
+
+        if (close(streamFd) != 0)
+        {
+                printf("Closing the frame stream returned error\n");
+                result = CONST_NOK;
+        }
+        streamFd = -1;
+
+        return result;
+}
@@ -0,0 +1,30 @@
+#ifndef CLICHIP_8_STREAM_H
+#define CLICHIP_8_STREAM_H
+
+#include "CLICHIP_8_core.h"
+
+
+
+
+
+/**
+ * @brief Binary framebuffer stream, in host byte order.
+ * The stream starts with the 4 magic bytes, then one record per frame:
+ * - 4 bytes frame number
+ * - 4 bytes cycle count
+ * - 1 byte amount of changed rows
+ * - for each changed row, 1 byte row index followed by the 8 bytes XOR delta against the previous frame
+ */
+#define CONST_STREAM_MAGIC "CH8F"
+#define CONST_STREAM_MAGIC_SIZE 4
+#define CONST_STREAM_BATCH_FRAMES 8  // Frames gathered before a single writev() call
+
+
+
+
+/* Functions */
+__uint8_t stream_open(const char *path);
+__uint8_t stream_frame(__uint32_t cycles);
+__uint8_t stream_close(void);
+
+#endif